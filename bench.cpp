@@ -0,0 +1,245 @@
+extern "C" {
+    #include <unistd.h>         /* fork, execv, access */
+    #include <fcntl.h>          /* O_ constants */
+    #include <spawn.h>          /* posix_spawn */
+    #include <signal.h>         /* raise, SIGSTOP */
+    #include <sys/wait.h>       /* wait4, waitpid */
+    #include <sys/ptrace.h>     /* ptrace */
+    #include <sys/resource.h>   /* rusage struct */
+}
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+
+#include "nolibc.h"             /* now_ns */
+
+#define DEFAULT_RUNS        1000
+#define DEV_NULL            "/dev/null"
+
+extern char **environ;
+
+struct BenchResult {
+    std::string command;
+    size_t runs {0};
+    std::vector<long> wall_ns;
+    long minflt {0};
+    long ctxsw {0};
+    long syscalls {-1};
+
+    /**
+     * Returns the wall time at the given percentile in microseconds.
+     */
+    double percentile_us(double p) {
+        if (wall_ns.empty()) return 0;
+
+        std::sort(wall_ns.begin(), wall_ns.end());
+        size_t idx = (size_t) (p / 100.0 * (wall_ns.size() - 1) + 0.5);
+
+        return wall_ns[idx] / 1000.0;
+    }
+};
+
+/**
+ * Splits a command string into its arguments at every space.
+ */
+std::vector<std::string> split_command(const std::string &command) {
+    std::vector<std::string> args;
+    std::istringstream command_stream (command);
+    std::string arg;
+
+    while (command_stream >> arg) {
+        args.push_back(arg);
+    }
+
+    return args;
+}
+
+/**
+ * Returns a null-terminated argv array pointing into the given arguments.
+ */
+std::vector<char*> to_argv(std::vector<std::string> &args) {
+    std::vector<char*> argv;
+
+    for (auto &arg : args) {
+        argv.push_back(arg.data());
+    }
+
+    argv.push_back(nullptr);
+
+    return argv;
+}
+
+/**
+ * Runs the command once with its output discarded and adds the wall time,
+ * minor page faults and context switches to the result. Returns false if the
+ * command could not be spawned.
+ */
+bool run_once(std::vector<char*> &argv, BenchResult &result) {
+    posix_spawn_file_actions_t actions;
+    struct rusage usage;
+    pid_t pid;
+    int status;
+
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, DEV_NULL, O_WRONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, DEV_NULL, O_WRONLY, 0);
+
+    long start = nolibc::now_ns();
+    int ret = posix_spawn(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+
+    posix_spawn_file_actions_destroy(&actions);
+    if (ret != 0) return false;
+
+    if (wait4(pid, &status, 0, &usage) == -1) return false;
+    long end = nolibc::now_ns();
+
+    result.wall_ns.push_back(end - start);
+    result.minflt += usage.ru_minflt;
+    result.ctxsw += usage.ru_nvcsw + usage.ru_nivcsw;
+    ++result.runs;
+
+    return true;
+}
+
+/**
+ * Returns the number of syscalls the command makes (including its execve),
+ * counted by tracing it with ptrace, or -1 if it cannot be traced.
+ */
+long count_syscalls(std::vector<char*> &argv) {
+    pid_t pid = fork();
+    if (pid == -1) return -1;
+
+    if (pid == 0) {
+        int dev_null = open(DEV_NULL, O_WRONLY);
+
+        dup2(dev_null, STDOUT_FILENO);
+        dup2(dev_null, STDERR_FILENO);
+
+        // Stop before the exec so the parent can set the trace options
+        ptrace(PTRACE_TRACEME, 0, nullptr, nullptr);
+        raise(SIGSTOP);
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+
+    int status;
+    if (waitpid(pid, &status, 0) == -1 || !WIFSTOPPED(status)) return -1;
+
+    ptrace(PTRACE_SETOPTIONS, pid, nullptr,
+           PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL);
+
+    long syscalls = 0;
+    bool in_syscall = false;
+
+    while (ptrace(PTRACE_SYSCALL, pid, nullptr, nullptr) == 0) {
+        if (waitpid(pid, &status, 0) == -1) return -1;
+        if (WIFEXITED(status) || WIFSIGNALED(status)) return syscalls;
+
+        // Syscall stops come in pairs of entry and exit, only count entries
+        if (WSTOPSIG(status) == (SIGTRAP | 0x80)) {
+            if (!in_syscall) ++syscalls;
+
+            in_syscall = !in_syscall;
+        }
+    }
+
+    // ptrace is not permitted, e.g. by seccomp or yama
+    kill(pid, SIGKILL);
+    waitpid(pid, &status, 0);
+
+    return -1;
+}
+
+/**
+ * Benchmarks the given command for the given amount of runs.
+ */
+BenchResult bench_command(const std::string &command, size_t runs) {
+    BenchResult result;
+    BenchResult warmup;
+    std::vector<std::string> args {split_command(command)};
+    std::vector<char*> argv {to_argv(args)};
+
+    result.command = command;
+    result.wall_ns.reserve(runs);
+
+    if (args.empty() || access(argv[0], X_OK) != 0) return result;
+
+    // Warm up the page cache before measuring
+    if (!run_once(argv, warmup)) return result;
+
+    for (size_t i {0}; i < runs; ++i) {
+        if (!run_once(argv, result)) break;
+    }
+
+    result.syscalls = count_syscalls(argv);
+
+    return result;
+}
+
+/**
+ * Prints the results as a table to the standard output.
+ */
+void print_bench_results(std::vector<BenchResult> results) {
+    std::cout << std::left << std::setw(32) << "command"
+              << std::right << std::setw(8) << "runs"
+              << std::setw(12) << "p50 us"
+              << std::setw(12) << "p99 us"
+              << std::setw(10) << "minflt"
+              << std::setw(8) << "ctxsw"
+              << std::setw(10) << "syscalls" << std::endl;
+
+    for (auto &result : results) {
+        std::cout << std::left << std::setw(32) << result.command
+                  << std::right << std::setw(8) << result.runs;
+
+        if (result.runs == 0) {
+            std::cout << "  (not runnable, skipped)" << std::endl;
+            continue;
+        }
+
+        std::cout << std::fixed << std::setprecision(1)
+                  << std::setw(12) << result.percentile_us(50)
+                  << std::setw(12) << result.percentile_us(99)
+                  << std::setw(10) << (double) result.minflt / result.runs
+                  << std::setw(8) << (double) result.ctxsw / result.runs
+                  << std::setw(10);
+
+        if (result.syscalls >= 0) {
+            std::cout << result.syscalls;
+        } else {
+            std::cout << "n/a";
+        }
+
+        std::cout << std::endl;
+    }
+}
+
+int main(int argc, const char *argv[]) {
+    size_t runs = DEFAULT_RUNS;
+    int i = 1;
+
+    if (argc > 2 && std::string(argv[1]) == "-n") {
+        runs = strtoul(argv[2], nullptr, 10);
+        i = 3;
+    }
+
+    if (i >= argc || runs == 0) {
+        std::cerr << "Usage: ./bench [-n RUNS] COMMAND..." << std::endl;
+        std::cerr << "Each COMMAND is a single argument, e.g. \"./statx Makefile\"" << std::endl;
+        return -1;
+    }
+
+    std::vector<BenchResult> results;
+
+    for (; i < argc; ++i) {
+        results.push_back(bench_command(argv[i], runs));
+    }
+
+    print_bench_results(results);
+
+    return 0;
+}
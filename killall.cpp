@@ -1,106 +1,73 @@
-extern "C" {
-    #include <unistd.h>     /* write syscall */
-    #include <fcntl.h>      /* open syscall, AT_ constants */
-    #include <signal.h>     /* kill syscall */
-    #include <dirent.h>     /* getdents64 syscall */
-    #include <stdlib.h>     /* malloc, free, strtol */
-}
+#include "nolibc.h"         /* open, getdents64 and kill syscalls, SIGKILL */
+#include "stats.h"          /* --stats instrumentation */
+#include "multicall.h"      /* APPLET_MAIN */
 
-#define FD_STDOUT           1
-#define FD_STDERR           2
 #define PROCFS_MOUNT        "/proc/"    // pre- and suffix with /
 #define BUF_SIZE            1024
+#define DT_DIR              4
 
-/**
- * Return the length of a given c-style char string. Assumes that the string is
- * terminated with a null-byte character.
- */
-size_t strlen(const char *str, char end = '\0') {
-    const char *ptr = str;
-
-    // traverse the string until a null-byte occurs
-    while (*ptr != end) ++ptr;
-
-    // get length from pointer positions
-    return (ptr - str);
-}
+using nolibc::println;
+using nolibc::strlen;
 
 /**
- * Returns a concatenated c-style char string.
+ * Copies src to dest and returns the position after the last copied char.
  */
-char* strcat(char *dest, const char *src) {
-    //
-    char *ptr = dest + strlen(dest);
-
-    // append src to dest until the end
+char* str_append(char *dest, const char *src) {
     while (*src != '\0') {
-        *ptr++ = *src++;
+        *dest++ = *src++;
     }
 
-    // terminate string with null byte
-    *ptr = '\0';
-
     return dest;
 }
 
 /**
- * Returns whether the needle was found in the haystack.
- * Implementation of the Knuth-Morris-Pratt algorithm.
+ * Writes the path of a file under the /proc hierarchy into the given buffer.
  */
-char* strstr(char *haystack, const char *needle) {
-    while(*haystack != '\0') {
-        const char *str = haystack;
-        const char *sstr = needle;
-
-        while (*str && *sstr && (*str == *sstr)) {
-            ++str;
-            ++sstr;
-        }
-
-        if (*sstr == '\0') {
-            return haystack;
-        }
-
-        ++haystack;
-    }
+void get_proc_path(char proc_path[], const char d_name[],
+                   const char file_name[]) {
+    char *ptr = proc_path;
 
-    return nullptr;
-}
+    ptr = str_append(ptr, PROCFS_MOUNT);
+    ptr = str_append(ptr, d_name);
+    ptr = str_append(ptr, file_name);
 
-/**
- * Prints the given string to console.
- */
-void print(const char *str = "", int fd = FD_STDOUT) {
-    write(fd, str, strlen(str));
+    *ptr = '\0';
 }
 
 /**
- * Print the given string as a line to console.
+ * Returns whether the first line of the process' status file, which holds
+ * its name, contains the given name.
  */
-void println(const char *str = "", int fd = FD_STDOUT) {
-    print(str, fd);
-    print("\n", fd);
-}
+bool proc_name_matches(const char d_name[], const char proc_kill_name[]) {
+    char proc_info_path[BUF_SIZE];  /* path of the status file */
+    char proc_name[BUF_SIZE];       /* process name buffer */
+    stats::PhaseTimer timer {"status"};
+
+    get_proc_path(proc_info_path, d_name, "/status");
+
+    // read the process name file into the buffer
+    int proc_fd = nolibc::open(proc_info_path, O_RDONLY);
+    if (proc_fd < 0) {
+        if (proc_fd == -ENOENT || proc_fd == -ESRCH) stats::count_vanished();
+        return false;
+    }
 
-/**
- * Get the name of the processes name file.
- * This is not an efficient solution at all.
- */
-char* get_proc_path(char d_name[], const char file_name[]) {
-    size_t length = strlen(PROCFS_MOUNT) +
-                    strlen(d_name) +
-                    strlen(file_name);
+    nolibc::ssize_t nread = nolibc::read(proc_fd, proc_name, BUF_SIZE - 1);
+    nolibc::close(proc_fd);
+    stats::count_read(nread);
 
-    char *proc_name = (char *) malloc(sizeof(char*) * length);
+    if (nread <= 0) return false;
 
-    strcat(proc_name, PROCFS_MOUNT);
-    strcat(proc_name, d_name);
-    strcat(proc_name, file_name);
+    // only keep the first line
+    proc_name[nread] = '\n';
+    proc_name[strlen(proc_name, '\n')] = '\0';
 
-    return proc_name;
+    return nolibc::strstr(proc_name, proc_kill_name) != nullptr;
 }
 
-int main(int argc, const char *argv[]) {
+int APPLET_MAIN(killall)(int argc, const char *argv[]) {
+    stats::parse_flag(argc, argv);
+
     if (argc < 2) {
         println("Usage: ./killall NAME", FD_STDERR);
         return -1;
@@ -110,59 +77,47 @@ int main(int argc, const char *argv[]) {
 
     int                     fd;                 /* file descriptor of procfs */
     char                    buf[BUF_SIZE];      /* buffer for reading procfs */
-    size_t                  nread;              /* read bytes from getdents64 */
-    size_t                  bpos;               /* current buffer pos */
-    struct dirent64         *d = nullptr;       /* current dir entry */
-    int                     proc_fd;            /* current process fd */
-    char                    proc_name[BUF_SIZE];/* process name buffer */
-    int                     proc_name_nread;    /* process name length */
-
-    fd = open(PROCFS_MOUNT, O_RDONLY | O_DIRECTORY);
-
-    do {
-        nread = getdents64(fd, buf, BUF_SIZE);
+    nolibc::ssize_t         nread;              /* read bytes from getdents64 */
+    nolibc::ssize_t         bpos;               /* current buffer pos */
+    nolibc::linux_dirent64  *d = nullptr;       /* current dir entry */
+    unsigned long long      kill_pid;           /* pid of the current entry */
 
-        // stop if there is nothing left to read
-        if (nread == 0) break;
+    fd = nolibc::open(PROCFS_MOUNT, O_RDONLY | O_DIRECTORY);
 
-        // go through all directory entries in procfs
-        for (bpos = 0; bpos < nread;) {
-            d = (struct dirent64 *) (buf + bpos);
-
-            // skip any entry that is not a folder
-            if (d->d_type != DT_DIR) break;
-
-            // skip any folder which does not start with a number
-            if (d->d_name[0] < '0' || d->d_name[0] > '9') break;
+    if (fd < 0) {
+        println("Error: Could not open " PROCFS_MOUNT, FD_STDERR);
+        return -1;
+    }
 
-            char* proc_info_path = get_proc_path(d->d_name, "/status");
+    {
+        stats::PhaseTimer timer {"scan"};
 
-            // read the process name file into the buffer
-            if ((proc_fd = open(proc_info_path, O_RDONLY)) == -1)
-                continue;
-            if ((proc_name_nread = read(proc_fd, proc_name, BUF_SIZE)) == -1)
-                continue;
+        do {
+            nread = nolibc::getdents64(fd, buf, BUF_SIZE);
 
-            free(proc_info_path);
+            // stop if there is nothing left to read
+            if (nread <= 0) break;
 
-            proc_name[strlen(proc_name, '\n')] = '\0';
+            // go through all directory entries in procfs
+            for (bpos = 0; bpos < nread; bpos += d->d_reclen) {
+                d = (nolibc::linux_dirent64 *) (buf + bpos);
 
-            bool to_kill = strstr(proc_name, proc_kill_name) != nullptr;
+                // skip any entry that is not a folder
+                if (d->d_type != DT_DIR) continue;
 
-            if (to_kill) {
-                pid_t kill_pid = (pid_t) strtol(d->d_name, (char**) nullptr, 10);
+                // skip any folder which is not a number
+                if (!nolibc::str_to_uint(d->d_name, kill_pid)) continue;
 
-                kill(kill_pid, SIGKILL);
+                if (proc_name_matches(d->d_name, proc_kill_name)) {
+                    stats::PhaseTimer timer {"kill"};
+                    nolibc::kill((nolibc::pid_t) kill_pid, SIGKILL);
+                }
             }
+        } while (nread > 0);
+    }
 
-            close(proc_fd);
-
-            // increment bpos
-            bpos += d->d_reclen;
-        }
-    } while(nread > 0);
-
-    close(fd);
+    nolibc::close(fd);
+    stats::report();
 
     return 0;
 }
@@ -0,0 +1,68 @@
+#include <cstring>
+#include <iostream>
+
+#include "multicall.h"
+
+int uname_main(int argc, const char *argv[]);
+int statx_main(int argc, const char *argv[]);
+int killall_main(int argc, const char *argv[]);
+int ps_main(int argc, const char *argv[]);
+int pstree_main(int argc, const char *argv[]);
+
+struct Applet {
+    const char *name;
+    int (*main)(int argc, const char *argv[]);
+};
+
+static const Applet applets[] {
+    {"uname", uname_main},
+    {"statx", statx_main},
+    {"killall", killall_main},
+    {"ps", ps_main},
+    {"pstree", pstree_main},
+};
+
+/**
+ * Returns the applet with the given name or nullptr if there is none.
+ */
+const Applet* find_applet(const char *name) {
+    for (const auto &applet : applets) {
+        if (strcmp(applet.name, name) == 0) return &applet;
+    }
+
+    return nullptr;
+}
+
+/**
+ * Returns the last component of the given path.
+ */
+const char* get_applet_name(const char *path) {
+    const char *name = strrchr(path, '/');
+
+    return name != nullptr ? name + 1 : path;
+}
+
+int main(int argc, const char *argv[]) {
+    // Dispatch on the name it was called with, e.g. through a symlink
+    const Applet *applet = find_applet(get_applet_name(argv[0]));
+
+    if (applet != nullptr) {
+        return applet->main(argc, argv);
+    }
+
+    // Otherwise, the applet is given as the first argument
+    if (argc > 1 && (applet = find_applet(argv[1])) != nullptr) {
+        return applet->main(argc - 1, argv + 1);
+    }
+
+    std::cerr << "Usage: ./multicall APPLET [ARGS...]" << std::endl;
+    std::cerr << "Applets:";
+
+    for (const auto &applet : applets) {
+        std::cerr << " " << applet.name;
+    }
+
+    std::cerr << std::endl;
+
+    return -1;
+}
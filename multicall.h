@@ -0,0 +1,15 @@
+#ifndef MULTICALL_H
+#define MULTICALL_H
+
+/*
+ * Every tool names its entry point with APPLET_MAIN(name). In a normal build
+ * this is plain `main`, in the multicall build (-DMULTICALL) it becomes
+ * `name_main`, which multicall.cpp dispatches to.
+ */
+#ifdef MULTICALL
+#define APPLET_MAIN(name)   name##_main
+#else
+#define APPLET_MAIN(name)   main
+#endif
+
+#endif
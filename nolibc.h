@@ -0,0 +1,413 @@
+#ifndef NOLIBC_H
+#define NOLIBC_H
+
+/*
+ * Minimal freestanding runtime for the tools that do not need libc.
+ *
+ * When compiled with -ffreestanding (__STDC_HOSTED__ == 0) this header also
+ * provides the `_start` entry point and the mem* functions the compiler may
+ * emit calls to, so the program can be linked with -nostdlib -static. In a
+ * hosted build only the syscall wrappers and the buffered writers are used.
+ *
+ * All syscall wrappers return the raw kernel result, i.e. a negative errno
+ * value on failure.
+ */
+
+#include <stddef.h>             /* size_t */
+#include <asm/unistd.h>         /* __NR_* syscall numbers */
+#include <linux/utsname.h>      /* new_utsname struct */
+
+// The kernel headers clash with the libc ones, so take the definitions from
+// libc if there is one
+#if __STDC_HOSTED__
+    #include <errno.h>          /* E* constants */
+    #include <fcntl.h>          /* O_* flags, AT_ constants */
+    #include <signal.h>         /* SIG* constants */
+    #include <time.h>           /* timespec struct, CLOCK_ constants */
+    #include <sys/stat.h>       /* statx struct, STATX_ masks, S_ mode bits */
+    #include <sys/resource.h>   /* rusage struct, RUSAGE_ constants */
+#else
+    #include <linux/errno.h>
+    #include <linux/fcntl.h>
+    #include <linux/signal.h>
+    #include <linux/time.h>
+    #include <linux/stat.h>
+    #include <linux/resource.h>
+#endif
+
+#define FD_STDOUT           1
+#define FD_STDERR           2
+#define WRITER_BUF_SIZE     4096
+
+namespace nolibc {
+    using ssize_t = long;
+    using pid_t = int;
+
+    /**
+     * Directory entry as returned by the getdents64 syscall.
+     */
+    struct linux_dirent64 {
+        __u64 d_ino;
+        __s64 d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[256];
+    };
+
+    /**
+     * Raw syscall with up to six arguments (x86-64 calling convention).
+     */
+    inline long syscall(long nr, long a1 = 0, long a2 = 0, long a3 = 0,
+                        long a4 = 0, long a5 = 0, long a6 = 0) {
+        register long r10 __asm__("r10") = a4;
+        register long r8 __asm__("r8") = a5;
+        register long r9 __asm__("r9") = a6;
+        long ret;
+
+        __asm__ volatile ("syscall"
+                          : "=a" (ret)
+                          : "a" (nr), "D" (a1), "S" (a2), "d" (a3),
+                            "r" (r10), "r" (r8), "r" (r9)
+                          : "rcx", "r11", "memory");
+
+        return ret;
+    }
+
+    inline ssize_t read(int fd, void *buf, size_t count) {
+        return syscall(__NR_read, fd, (long) buf, (long) count);
+    }
+
+    inline ssize_t write(int fd, const void *buf, size_t count) {
+        return syscall(__NR_write, fd, (long) buf, (long) count);
+    }
+
+    inline int open(const char *pathname, int flags) {
+        return syscall(__NR_openat, AT_FDCWD, (long) pathname, flags);
+    }
+
+    inline int close(int fd) {
+        return syscall(__NR_close, fd);
+    }
+
+    inline ssize_t getdents64(int fd, void *dirp, size_t count) {
+        return syscall(__NR_getdents64, fd, (long) dirp, (long) count);
+    }
+
+    inline int kill(pid_t pid, int sig) {
+        return syscall(__NR_kill, pid, sig);
+    }
+
+    inline int uname(struct new_utsname *buf) {
+        return syscall(__NR_uname, (long) buf);
+    }
+
+    inline int statx(int dirfd, const char *pathname, int flags,
+                     unsigned int mask, struct statx *statxbuf) {
+        return syscall(__NR_statx, dirfd, (long) pathname, flags, mask,
+                       (long) statxbuf);
+    }
+
+    inline int clock_gettime(int clockid, struct timespec *tp) {
+#if __STDC_HOSTED__
+        // libc reads the clock through the vDSO without entering the kernel
+        return ::clock_gettime(clockid, tp) == 0 ? 0 : -errno;
+#else
+        return syscall(__NR_clock_gettime, clockid, (long) tp);
+#endif
+    }
+
+    /**
+     * Returns the monotonic time in nanoseconds.
+     */
+    inline long long now_ns() {
+        struct timespec ts;
+
+        nolibc::clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    }
+
+    inline int getrusage(int who, struct rusage *usage) {
+        return syscall(__NR_getrusage, who, (long) usage);
+    }
+
+    [[noreturn]] inline void exit_group(int status) {
+        for (;;) syscall(__NR_exit_group, status);
+    }
+
+    /**
+     * Return the length of a given c-style char string. Assumes that the
+     * string is terminated with the given end character.
+     */
+    inline size_t strlen(const char *str, char end = '\0') {
+        const char *ptr = str;
+
+        // traverse the string until the end character occurs
+        while (*ptr != end) ++ptr;
+
+        // get length from pointer positions
+        return (ptr - str);
+    }
+
+    /**
+     * Returns whether the two given strings are equal.
+     */
+    inline bool str_equal(const char *lhs, const char *rhs) {
+        while (*lhs != '\0' && *lhs == *rhs) {
+            ++lhs;
+            ++rhs;
+        }
+
+        return *lhs == *rhs;
+    }
+
+    /**
+     * Returns the first occurrence of the needle in the haystack or nullptr
+     * if there is none.
+     */
+    inline const char* strstr(const char *haystack, const char *needle) {
+        for (; *haystack != '\0'; ++haystack) {
+            const char *str = haystack;
+            const char *sstr = needle;
+
+            while (*str && *sstr && (*str == *sstr)) {
+                ++str;
+                ++sstr;
+            }
+
+            if (*sstr == '\0') return haystack;
+        }
+
+        return nullptr;
+    }
+
+    /**
+     * Convert an unsigned integer to a c-style string. The buffer needs to
+     * hold at least 21 characters. Returns the length of the string.
+     */
+    inline size_t uint_to_str(unsigned long long num, char str[]) {
+        char tmp[20];
+        size_t len = 0;
+
+        do {
+            tmp[len++] = num % 10 + '0';
+            num /= 10;
+        } while (num > 0);
+
+        for (size_t i = 0; i < len; ++i) {
+            str[i] = tmp[len - i - 1];
+        }
+
+        str[len] = '\0';
+
+        return len;
+    }
+
+    /**
+     * Parse a decimal unsigned integer. Returns false if the string is empty
+     * or contains anything but digits.
+     */
+    inline bool str_to_uint(const char *str, unsigned long long &num) {
+        if (*str == '\0') return false;
+
+        for (num = 0; *str != '\0'; ++str) {
+            if (*str < '0' || *str > '9') return false;
+
+            num = num * 10 + (*str - '0');
+        }
+
+        return true;
+    }
+
+    /**
+     * Collects output in a fixed buffer and writes it out with as few write
+     * syscalls as possible.
+     */
+    struct Writer {
+        int fd;
+        char *buf;
+        size_t len {0};
+
+        /**
+         * Writes all of the given bytes, retrying on short writes. Gives up
+         * on the first error.
+         */
+        void write_all(const char *str, size_t count) {
+            size_t pos = 0;
+
+            while (pos < count) {
+                ssize_t nwritten = nolibc::write(fd, str + pos, count - pos);
+                if (nwritten <= 0) break;
+
+                pos += nwritten;
+            }
+        }
+
+        void flush() {
+            write_all(buf, len);
+            len = 0;
+        }
+
+        void write(const char *str, size_t count) {
+            // bypass the buffer for chunks that would not fit anyway
+            if (count > WRITER_BUF_SIZE - len) {
+                flush();
+
+                if (count >= WRITER_BUF_SIZE) {
+                    write_all(str, count);
+                    return;
+                }
+            }
+
+            for (size_t i = 0; i < count; ++i) {
+                buf[len++] = str[i];
+            }
+        }
+
+        void write(const char *str) {
+            write(str, strlen(str));
+        }
+
+        void write_uint(unsigned long long num) {
+            char str[21];
+
+            write(str, uint_to_str(num, str));
+        }
+    };
+
+    // keep the buffers apart from the writers so they end up in .bss
+    inline char out_buf[WRITER_BUF_SIZE];
+    inline char err_buf[WRITER_BUF_SIZE];
+
+    inline constinit Writer out {FD_STDOUT, out_buf};
+    inline constinit Writer err {FD_STDERR, err_buf};
+
+    /**
+     * Returns the buffered writer for the given file descriptor.
+     */
+    inline Writer& writer(int fd) {
+        return fd == FD_STDERR ? err : out;
+    }
+
+    /**
+     * Prints the given string to console.
+     */
+    inline void print(const char *str = "", int fd = FD_STDOUT) {
+        writer(fd).write(str);
+    }
+
+    /**
+     * Print the given string as a line to console.
+     */
+    inline void println(const char *str = "", int fd = FD_STDOUT) {
+        writer(fd).write(str);
+        writer(fd).write("\n", 1);
+    }
+
+    /**
+     * Flush the buffered writers, e.g. before the program terminates.
+     */
+    inline void flush() {
+        out.flush();
+        err.flush();
+    }
+
+    /**
+     * Flush the buffered writers and terminate the process.
+     */
+    [[noreturn]] inline void exit(int status) {
+        flush();
+        exit_group(status);
+    }
+
+#if __STDC_HOSTED__
+    /**
+     * In a hosted build main returns into libc, so flush the buffered
+     * writers on static destruction instead.
+     */
+    struct FlushAtExit {
+        ~FlushAtExit() {
+            flush();
+        }
+    };
+
+    inline FlushAtExit flush_at_exit;
+#endif
+}
+
+#if !__STDC_HOSTED__
+
+/*
+ * The compiler may emit calls to these even in freestanding code, e.g. for
+ * zero-initializing buffers or copying structs. Build with
+ * -fno-tree-loop-distribute-patterns so the loops are not turned into calls
+ * to themselves.
+ */
+extern "C" {
+    void* memset(void *dest, int c, size_t n) {
+        unsigned char *d = (unsigned char *) dest;
+
+        while (n--) *d++ = (unsigned char) c;
+
+        return dest;
+    }
+
+    void* memcpy(void *dest, const void *src, size_t n) {
+        unsigned char *d = (unsigned char *) dest;
+        const unsigned char *s = (const unsigned char *) src;
+
+        while (n--) *d++ = *s++;
+
+        return dest;
+    }
+
+    void* memmove(void *dest, const void *src, size_t n) {
+        unsigned char *d = (unsigned char *) dest;
+        const unsigned char *s = (const unsigned char *) src;
+
+        if (d < s) {
+            while (n--) *d++ = *s++;
+        } else {
+            while (n--) d[n] = s[n];
+        }
+
+        return dest;
+    }
+
+    int memcmp(const void *lhs, const void *rhs, size_t n) {
+        const unsigned char *l = (const unsigned char *) lhs;
+        const unsigned char *r = (const unsigned char *) rhs;
+
+        for (; n--; ++l, ++r) {
+            if (*l != *r) return *l - *r;
+        }
+
+        return 0;
+    }
+
+    [[noreturn]] void nolibc_exit(int status) {
+        nolibc::exit(status);
+    }
+}
+
+/*
+ * Process entry point. The kernel leaves argc at the top of the stack,
+ * directly followed by the argv pointers. main's return value is handed to
+ * nolibc_exit, which flushes the buffered output.
+ */
+__asm__ (
+    ".text\n"
+    ".global _start\n"
+    "_start:\n"
+    "    xor  %ebp, %ebp\n"
+    "    mov  (%rsp), %rdi\n"
+    "    lea  8(%rsp), %rsi\n"
+    "    and  $-16, %rsp\n"
+    "    call main\n"
+    "    mov  %eax, %edi\n"
+    "    call nolibc_exit\n"
+);
+
+#endif
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef PROCFS_H
+#define PROCFS_H
+
+extern "C" {
+    #include <unistd.h>     /* read and readlink syscalls */
+    #include <fcntl.h>      /* open syscall */
+}
+
+#include <string>
+#include <cstdlib>
+#include <sstream>
+
+#include "stats.h"
+
+#define PROCFS_MOUNT        "/proc/"
+#define BUF_SIZE            8192
+
+inline void build_proc_path(std::ostringstream &oss) {
+    (void) oss; // ignore unused parameter
+}
+
+template<typename T, typename... Args>
+void build_proc_path(std::ostringstream &oss, const T& value, const Args&... args) {
+    oss << "/" << value;
+    build_proc_path(oss, args...);
+}
+
+/**
+ * Builds a path to the procfs with a variable amount of arguments.
+ */
+template<typename... Args>
+std::string build_proc_path(pid_t pid, const Args&... args) {
+    std::ostringstream oss;
+
+    oss << PROCFS_MOUNT << pid;
+    build_proc_path(oss, args...);
+
+    return oss.str();
+}
+
+/**
+ * Returns the content of a file under the /proc hierarchy.
+ */
+template<typename... Args>
+std::string get_proc_info_content(pid_t pid, const Args&... args) {
+    std::string proc_info_path {build_proc_path(pid, args...)};
+    char buf[BUF_SIZE];
+
+    int fd = open(proc_info_path.c_str(), O_RDONLY);
+    if (fd == -1) return {};
+
+    ssize_t nread = read(fd, buf, BUF_SIZE);
+    close(fd);
+
+    stats::count_read(nread);
+
+    if (nread == -1) return {};
+
+    return std::string(buf, nread);
+}
+
+/**
+ * Returns the link of a file under the /proc hierarchy.
+ */
+template<typename... Args>
+std::string get_proc_info_link(pid_t pid, const Args&... args) {
+    std::string proc_info_path {build_proc_path(pid, args...)};
+    char buf[BUF_SIZE];
+
+    ssize_t nread = readlink(proc_info_path.c_str(), buf, BUF_SIZE);
+    if (nread == -1) return {};
+
+    return std::string(buf, nread);
+}
+
+/**
+ * The fields of the `/proc/pid/stat` file the tools make use of.
+ */
+struct ProcStat {
+    std::string comm;
+    char state;
+    pid_t ppid;
+    unsigned long long cpu_time;    /* user and system time in clock ticks */
+    unsigned long long start_time;  /* in clock ticks after boot */
+    unsigned long long rss;         /* resident set size in pages */
+};
+
+/**
+ * Parses the `/proc/pid/stat` file. Returns false if the process is gone.
+ */
+inline bool parse_proc_stat(pid_t pid, ProcStat &stat) {
+    std::string stat_content {get_proc_info_content(pid, "stat")};
+
+    // The name may contain any character, so it is delimited by the first
+    // opening and the last closing parenthesis (see `man 5 proc`)
+    auto comm_start = stat_content.find('(');
+    auto comm_end = stat_content.rfind(')');
+
+    if (comm_start == std::string::npos || comm_end == std::string::npos ||
+        comm_end < comm_start || comm_end + 2 > stat_content.size()) {
+        return false;
+    }
+
+    stat.comm = stat_content.substr(comm_start + 1, comm_end - comm_start - 1);
+
+    std::istringstream stat_content_stream {stat_content.substr(comm_end + 2)};
+    std::string tmp;
+    unsigned long long utime, stime;
+
+    // The state and parent pid are the third and fourth field, the user and
+    // system time the 14th and 15th, the start time the 22nd and the
+    // resident set size the 24th field
+    stat_content_stream >> stat.state >> stat.ppid;
+    for (int i {5}; i < 14; ++i) stat_content_stream >> tmp;
+    stat_content_stream >> utime >> stime;
+    for (int i {16}; i < 22; ++i) stat_content_stream >> tmp;
+    stat_content_stream >> stat.start_time >> tmp >> stat.rss;
+
+    stat.cpu_time = utime + stime;
+
+    return !stat_content_stream.fail();
+}
+
+/**
+ * Counts the process as vanished mid-scan if its procfs directory is gone.
+ * Only checked with --stats, as a failed read alone does not tell, e.g. the
+ * exe link of kernel threads cannot be read either.
+ */
+inline void count_if_vanished(pid_t pid) {
+    if (stats::collected.enabled && access(build_proc_path(pid).c_str(), F_OK) == -1) {
+        stats::count_vanished();
+    }
+}
+
+/**
+ * Returns the base address which is the first address mapped to the process.
+ */
+inline unsigned long long get_proc_base_address(pid_t pid, const std::string &exe) {
+    std::string maps_content {get_proc_info_content(pid, "maps")};
+    std::istringstream maps_content_stream (maps_content);
+
+    std::string line;
+    while (std::getline(maps_content_stream, line)) {
+        std::istringstream linestream (line);
+        std::string address, perms, offset, dev, inode, path;
+
+        if (!(linestream >> address >> perms >> offset >> dev >> inode >> path)) {
+            continue;
+        }
+
+        auto offset_num = strtoul(offset.c_str(), nullptr, 16);
+
+        if (path == exe && offset_num == 0) {
+            auto base_address = address.substr(0, address.find('-'));
+
+            return strtoull(base_address.c_str(), nullptr, 16);
+        }
+    }
+
+    return 0;
+}
+
+#endif
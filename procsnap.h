@@ -0,0 +1,170 @@
+#ifndef PROCSNAP_H
+#define PROCSNAP_H
+
+extern "C" {
+    #include <unistd.h>     /* close syscall */
+    #include <fcntl.h>      /* O_ constants */
+    #include <sys/mman.h>   /* shm_open, mmap */
+    #include <sys/stat.h>   /* fstat */
+}
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "nolibc.h"         /* now_ns */
+
+/*
+ * Layout of the shared-memory process snapshot published by procsnapd.
+ *
+ * The region holds two buffers. The daemon always fills the one that is not
+ * active and then flips `active` over to it. Each buffer carries its own
+ * sequence counter, which is odd while the buffer is being written, so a
+ * reader can detect that the daemon lapped it and retry without taking any
+ * lock. Readers validate every offset, as they may read a torn buffer before
+ * the sequence check tells them to retry.
+ */
+namespace procsnap {
+    constexpr const char *SHM_NAME = "/procsnap";
+    constexpr uint32_t MAGIC = 0x70736e70;       /* "psnp" */
+    constexpr uint32_t VERSION = 2;
+    constexpr uint32_t MAX_ENTRIES = 16384;
+    constexpr uint32_t STRINGS_SIZE = 4 << 20;
+    constexpr int READ_RETRIES = 8;
+
+    // Snapshots older than this many intervals are considered stale, e.g.
+    // because the daemon is no longer running. The interval is taken from
+    // the region, so readers cap it instead of trusting it.
+    constexpr long STALE_INTERVALS = 3;
+    constexpr uint32_t MAX_INTERVAL_MS = 10000;
+
+    struct Entry {
+        pid_t pid;
+        pid_t ppid;
+        char state;
+        unsigned long long base_address;
+        unsigned long long rss;     /* resident set size in pages */
+        unsigned long long cpu_time;/* user and system time in clock ticks */
+        uint32_t comm;              /* offsets into the string area */
+        uint32_t exe;
+        uint32_t cwd;
+        uint32_t cmdline;
+        uint32_t cmdline_len;       /* cmdline is null-separated */
+    };
+
+    struct Buffer {
+        std::atomic<uint64_t> seq;
+        int64_t updated_ns;         /* CLOCK_MONOTONIC of the scan */
+        uint32_t count;
+        bool complete;              /* false if entries or strings ran out */
+        Entry entries[MAX_ENTRIES];
+        char strings[STRINGS_SIZE]; /* the last byte always stays '\0' */
+
+        /**
+         * Returns the number of entries, bounded by the entry array.
+         */
+        uint32_t size() const {
+            return count < MAX_ENTRIES ? count : MAX_ENTRIES;
+        }
+
+        /**
+         * Returns the string at the given offset, or an empty string if the
+         * offset is out of bounds.
+         */
+        const char* string(uint32_t offset) const {
+            return offset < STRINGS_SIZE ? strings + offset : "";
+        }
+
+        /**
+         * Returns the null-separated cmdline of the given entry.
+         */
+        std::string cmdline(const Entry &entry) const {
+            if (entry.cmdline >= STRINGS_SIZE ||
+                entry.cmdline_len > STRINGS_SIZE - 1 - entry.cmdline) {
+                return {};
+            }
+
+            return std::string(strings + entry.cmdline, entry.cmdline_len);
+        }
+    };
+
+    struct Region {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t interval_ms;
+        std::atomic<uint32_t> active;
+        Buffer buffers[2];
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free);
+    static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+    /**
+     * Returns whether the region behind the given file descriptor can be
+     * trusted: /dev/shm is world-writable, so anyone could have created it.
+     * It has to belong to root or the current user and must not be writable
+     * by anyone else.
+     */
+    inline bool is_trusted_region(int fd) {
+        struct stat shm_stat;
+
+        if (fstat(fd, &shm_stat) == -1) return false;
+        if ((size_t) shm_stat.st_size < sizeof(Region)) return false;
+        if (shm_stat.st_uid != 0 && shm_stat.st_uid != geteuid()) return false;
+
+        return (shm_stat.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+    }
+
+    /**
+     * Calls the given function with the active buffer of the snapshot
+     * region. The function may be called more than once if the daemon
+     * overwrites the buffer while it is being read, so it has to discard the
+     * results of earlier calls. Returns false if there is no complete and
+     * recent snapshot, in which case the caller should scan /proc itself.
+     */
+    template<typename F>
+    bool read_snapshot(F &&read_buffer) {
+        int fd = shm_open(SHM_NAME, O_RDONLY, 0);
+        if (fd == -1) return false;
+
+        if (!is_trusted_region(fd)) {
+            close(fd);
+            return false;
+        }
+
+        void *addr = mmap(nullptr, sizeof(Region), PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+
+        if (addr == MAP_FAILED) return false;
+
+        const Region *region = (const Region *) addr;
+        bool success = false;
+
+        if (region->magic == MAGIC && region->version == VERSION) {
+            uint32_t interval_ms = region->interval_ms < MAX_INTERVAL_MS ?
+                                   region->interval_ms : MAX_INTERVAL_MS;
+            int64_t max_age_ns = STALE_INTERVALS * interval_ms * 1000000L;
+
+            for (int i {0}; i < READ_RETRIES && !success; ++i) {
+                const Buffer &buf = region->buffers[region->active.load(std::memory_order_acquire) & 1];
+                uint64_t seq = buf.seq.load(std::memory_order_acquire);
+
+                // The daemon is still writing this buffer
+                if (seq & 1) continue;
+
+                if (!buf.complete || nolibc::now_ns() - buf.updated_ns > max_age_ns) break;
+
+                read_buffer(buf);
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                success = buf.seq.load(std::memory_order_relaxed) == seq;
+            }
+        }
+
+        munmap(addr, sizeof(Region));
+
+        return success;
+    }
+}
+
+#endif
@@ -0,0 +1,226 @@
+extern "C" {
+    #include <dirent.h>     /* getdents64 syscall */
+    #include <signal.h>     /* sigaction */
+    #include <sys/mman.h>   /* shm_open, mmap */
+}
+
+#include <string>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+#include "procfs.h"
+#include "procsnap.h"
+
+#define DEFAULT_INTERVAL_MS 1000
+
+/*
+ * The base address needs the maps file to be parsed, which is by far the
+ * most expensive part of a scan. It only changes when a process execs, so it
+ * is cached for each pid together with the start time and exe it was taken
+ * from.
+ */
+struct CachedBaseAddress {
+    unsigned long long start_time;
+    std::string exe;
+    unsigned long long base_address;
+};
+
+namespace procsnapd {
+    using base_address_cache = std::unordered_map<pid_t, CachedBaseAddress>;
+}
+
+static volatile sig_atomic_t running = 1;
+
+void stop_running(int) {
+    running = 0;
+}
+
+/**
+ * Appends the given bytes plus a null byte to the string area of the buffer
+ * and returns their offset. Returns offset 0, the empty string, and marks
+ * the buffer as incomplete if there is no room left.
+ */
+uint32_t add_string(procsnap::Buffer &buf, uint32_t &strings_len,
+                    const char *str, size_t len) {
+    // Keep the last byte of the string area as terminator for readers
+    if (len + 1 > procsnap::STRINGS_SIZE - 1 - strings_len) {
+        buf.complete = false;
+        return 0;
+    }
+
+    uint32_t offset = strings_len;
+
+    memcpy(buf.strings + offset, str, len);
+    buf.strings[offset + len] = '\0';
+    strings_len += len + 1;
+
+    return offset;
+}
+
+uint32_t add_string(procsnap::Buffer &buf, uint32_t &strings_len,
+                    const std::string &str) {
+    return add_string(buf, strings_len, str.data(), str.size());
+}
+
+/**
+ * Scans the procfs and fills the given buffer with the found processes.
+ */
+void fill_snapshot_buffer(procsnap::Buffer &buf, procsnapd::base_address_cache &cache) {
+    procsnapd::base_address_cache next_cache;
+    uint32_t strings_len = 0;
+
+    buf.count = 0;
+    buf.complete = true;
+    buf.strings[strings_len++] = '\0';
+
+    DIR *dir = opendir("/proc");
+    dirent *entry;
+
+    // Go through every directory entry in the procfs
+    while (dir != nullptr && (entry = readdir(dir)) != nullptr) {
+        pid_t pid;
+
+        // Only process entries that can be parsed as integers
+        if (sscanf(entry->d_name, "%d", &pid) != 1) continue;
+
+        if (buf.count == procsnap::MAX_ENTRIES) {
+            buf.complete = false;
+            break;
+        }
+
+        procsnap::Entry &proc = buf.entries[buf.count];
+        ProcStat proc_stat;
+
+        if (!parse_proc_stat(pid, proc_stat)) continue;
+
+        proc.pid = pid;
+        proc.ppid = proc_stat.ppid;
+        proc.state = proc_stat.state;
+        proc.rss = proc_stat.rss;
+        proc.cpu_time = proc_stat.cpu_time;
+
+        std::string exe {get_proc_info_link(pid, "exe")};
+        std::string cmdline {get_proc_info_content(pid, "cmdline")};
+
+        auto cached = cache.find(pid);
+        if (cached != cache.end() && cached->second.start_time == proc_stat.start_time &&
+            cached->second.exe == exe) {
+            proc.base_address = cached->second.base_address;
+        } else {
+            proc.base_address = exe.empty() ? 0 : get_proc_base_address(pid, exe);
+        }
+
+        next_cache[pid] = {proc_stat.start_time, exe, proc.base_address};
+
+        proc.comm = add_string(buf, strings_len, proc_stat.comm);
+        proc.exe = add_string(buf, strings_len, exe);
+        proc.cwd = add_string(buf, strings_len, get_proc_info_link(pid, "cwd"));
+        proc.cmdline = add_string(buf, strings_len, cmdline);
+        proc.cmdline_len = proc.cmdline == 0 ? 0 : cmdline.size();
+
+        ++buf.count;
+    }
+
+    if (dir != nullptr) closedir(dir);
+
+    cache.swap(next_cache);
+}
+
+/**
+ * Scans the procfs into the inactive buffer and makes it the active one.
+ */
+void publish_snapshot(procsnap::Region &region, procsnapd::base_address_cache &cache) {
+    uint32_t next = 1 - region.active.load(std::memory_order_relaxed);
+    procsnap::Buffer &buf = region.buffers[next];
+    uint64_t seq = buf.seq.load(std::memory_order_relaxed);
+
+    // Mark the buffer as being written for readers that still look at it
+    buf.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    fill_snapshot_buffer(buf, cache);
+    buf.updated_ns = nolibc::now_ns();
+
+    buf.seq.store(seq + 2, std::memory_order_release);
+    region.active.store(next, std::memory_order_release);
+}
+
+/**
+ * Creates the shared-memory region, which is only accessible by the user the
+ * daemon runs as, since it exposes the exe and cwd of every process the
+ * daemon can see. A region left behind by anyone else is never reused, as
+ * the mode only applies to a newly created file.
+ */
+procsnap::Region* create_region(uint32_t interval_ms) {
+    shm_unlink(procsnap::SHM_NAME);
+
+    int fd = shm_open(procsnap::SHM_NAME, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd == -1) return nullptr;
+
+    if (ftruncate(fd, sizeof(procsnap::Region)) == -1) {
+        close(fd);
+        return nullptr;
+    }
+
+    void *addr = mmap(nullptr, sizeof(procsnap::Region),
+                      PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (addr == MAP_FAILED) return nullptr;
+
+    procsnap::Region *region = (procsnap::Region *) addr;
+
+    region->version = procsnap::VERSION;
+    region->interval_ms = interval_ms;
+    region->buffers[0].complete = false;
+    region->buffers[1].complete = false;
+
+    // Publish the magic last, so readers never see a half-initialized region
+    std::atomic_thread_fence(std::memory_order_release);
+    region->magic = procsnap::MAGIC;
+
+    return region;
+}
+
+int main(int argc, const char *argv[]) {
+    uint32_t interval_ms = DEFAULT_INTERVAL_MS;
+
+    if (argc > 2 && strcmp(argv[1], "-i") == 0) {
+        interval_ms = strtoul(argv[2], nullptr, 10);
+    }
+
+    // Clients consider snapshots stale after a capped number of intervals
+    if (interval_ms == 0 || interval_ms > procsnap::MAX_INTERVAL_MS ||
+        (argc > 1 && argc != 3)) {
+        std::cerr << "Usage: ./procsnapd [-i INTERVAL_MS]" << std::endl;
+        std::cerr << "INTERVAL_MS is at most " << procsnap::MAX_INTERVAL_MS << std::endl;
+        return -1;
+    }
+
+    procsnap::Region *region = create_region(interval_ms);
+
+    if (region == nullptr) {
+        std::cerr << "Error: Could not create the shared memory region "
+                  << procsnap::SHM_NAME << std::endl;
+        return -1;
+    }
+
+    struct sigaction action {};
+    action.sa_handler = stop_running;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    procsnapd::base_address_cache cache;
+    struct timespec interval {interval_ms / 1000, (interval_ms % 1000) * 1000000L};
+
+    while (running) {
+        publish_snapshot(*region, cache);
+        nanosleep(&interval, nullptr);
+    }
+
+    // Let clients fall back to scanning the procfs themselves
+    shm_unlink(procsnap::SHM_NAME);
+
+    return 0;
+}
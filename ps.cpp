@@ -1,57 +1,18 @@
 extern "C" {
-    #include <unistd.h>     /* read and readlink syscalls */
-    #include <fcntl.h>      /* open syscall */
     #include <dirent.h>     /* getdents64 syscall */
 }
 
 #include <string>
 #include <vector>
+#include <cerrno>
 #include <sstream>
 #include <iostream>
+#include <algorithm>
 
-#define NAME_LIMIT          256
-#define BUF_SIZE            8192
-
-/**
- * Returns the path for a file under the /proc hierarchy.
- */
-std::string get_proc_path(pid_t pid, const char name[]) {
-    return "/proc/" + std::to_string(pid) + "/" + name;
-}
-
-/**
- * Returns the content of a file under the /proc hierarchy.
- */
-std::string get_proc_info_content(pid_t pid, const char name[]) {
-    std::string proc_info_path {get_proc_path(pid, name)};
-    char buf[BUF_SIZE];
-
-    int fd = open(proc_info_path.c_str(), O_RDONLY);
-    if (fd == -1) return {};
-
-    ssize_t nread = read(fd, buf, BUF_SIZE);
-    if (nread == -1) return {};
-
-    close(fd);
-    buf[nread] = '\0';
-
-    return std::string(buf, nread);
-}
-
-/**
- * Returns the link of a file under the /proc hierarchy.
- */
-std::string get_proc_info_link(pid_t pid, const char name[]) {
-    std::string proc_info_path {get_proc_path(pid, name)};
-    char buf[BUF_SIZE];
-
-    ssize_t nread = readlink(proc_info_path.c_str(), buf, BUF_SIZE);
-    if (nread == -1) return {};
-
-    buf[nread] = '\0';
-
-    return buf;
-}
+#include "procfs.h"
+#include "procsnap.h"
+#include "stats.h"
+#include "multicall.h"
 
 struct ProcInfo {
     pid_t pid;
@@ -86,99 +47,323 @@ struct ProcInfo {
 };
 
 /**
- * Returns the state indicated by a char defined in `man 5 proc` from the
- * `/proc/pid/stat` file.
+ * Returns an array of the command line arguments as strings, given the
+ * null-separated content of a `/proc/pid/cmdline` file.
  */
-char get_proc_state(pid_t pid) {
-    std::string stat_content {get_proc_info_content(pid, "stat")};
+std::vector<std::string> parse_cmdline(const std::string &cmdline_content) {
+    std::vector<std::string> cmdline_items;
+    std::istringstream cmdline_content_stream (cmdline_content);
 
-    // Get the position of the stat char, which is two characters after a
-    // closing parenthesis (see `man 5 proc`)
-    auto stat_pos = stat_content.find(')') + 2;
+    std::string arg;
 
-    // Return the char two characters after the parenthesis
-    return stat_content.at(stat_pos);
+    while (std::getline(cmdline_content_stream, arg, '\0')) {
+        std::istringstream arg_stream (arg);
+        std::string tmp;
+
+        while (std::getline(arg_stream, tmp, ' ')) {
+            cmdline_items.push_back(arg);
+        }
+    }
+
+    return cmdline_items;
 }
 
 /**
- * Returns the base address which is the first address mapped to the process.
+ * Returns an array of the command line arguments as strings.
  */
-unsigned long long get_proc_base_address(pid_t pid, std::string exe) {
-    std::string maps_content {get_proc_info_content(pid, "maps")};
-    std::istringstream maps_content_stream (maps_content);
+std::vector<std::string> get_proc_cmdline(pid_t pid) {
+    return parse_cmdline(get_proc_info_content(pid, "cmdline"));
+}
+
+enum class SortField {
+    none,
+    mem,        /* resident set size */
+    cpu,        /* user and system time */
+};
 
-    std::string line;
-    while (std::getline(maps_content_stream, line)) {
-        std::istringstream linestream (line);
-        std::string address, perms, offset, dev, inode, path;
+struct SortOptions {
+    SortField field {SortField::none};
+    size_t top {0};     /* 0 for no limit */
+};
 
-        if (!(linestream >> address >> perms >> offset >> dev >> inode >> path)) {
-            continue;
+struct SortCandidate {
+    pid_t pid;
+    unsigned long long value;
+    uint32_t entry {0}; /* index into the snapshot, if read from there */
+    ProcInfo info {};   /* links and state, if read from the procfs */
+};
+
+/**
+ * Returns whether the first candidate ranks before the second one, i.e. has
+ * the higher value, or the lower pid for equal values.
+ */
+bool ranks_before(const SortCandidate &lhs, const SortCandidate &rhs) {
+    return lhs.value > rhs.value || (lhs.value == rhs.value && lhs.pid < rhs.pid);
+}
+
+/**
+ * Keeps the best candidates seen so far, bounded by the top limit. The heap
+ * is ordered so that its front is the worst candidate kept, which is the one
+ * to evict when a better one comes along.
+ */
+struct TopCandidates {
+    size_t limit;
+    std::vector<SortCandidate> heap;
+
+    /**
+     * Returns whether the candidate would be kept, so that the caller can
+     * skip any further work for the ones that would not.
+     */
+    bool accepts(const SortCandidate &candidate) const {
+        return limit == 0 || heap.size() < limit || ranks_before(candidate, heap.front());
+    }
+
+    void push(SortCandidate candidate) {
+        if (limit != 0 && heap.size() == limit) {
+            std::pop_heap(heap.begin(), heap.end(), ranks_before);
+            heap.pop_back();
         }
 
-        auto offset_num = strtoul(offset.c_str(), nullptr, 16);
+        heap.push_back(std::move(candidate));
+        std::push_heap(heap.begin(), heap.end(), ranks_before);
+    }
+
+    /**
+     * Returns the kept candidates, best first.
+     */
+    std::vector<SortCandidate> sorted() {
+        std::sort_heap(heap.begin(), heap.end(), ranks_before);
+
+        return heap;
+    }
+};
+
+/**
+ * Returns the sort value of a parsed stat file.
+ */
+unsigned long long get_stat_sort_value(const ProcStat &proc_stat, SortField field) {
+    return field == SortField::mem ? proc_stat.rss : proc_stat.cpu_time;
+}
+
+/**
+ * Returns the sort value of a snapshot entry.
+ */
+unsigned long long get_entry_sort_value(const procsnap::Entry &entry, SortField field) {
+    return field == SortField::mem ? entry.rss : entry.cpu_time;
+}
+
+/**
+ * Calls the given function with the pid of every process in the procfs.
+ */
+template<typename F>
+void for_each_proc_pid(F &&visit) {
+    DIR *dir = opendir("/proc");
+    dirent *entry = readdir(dir);
 
-        if (path == exe && offset_num == 0) {
-            auto base_address = address.substr(0, address.find('-'));
+    // Go through every directory entry in the procfs
+    while ((entry = readdir(dir)) != nullptr) {
+        pid_t pid;
 
-            return strtoull(base_address.c_str(), nullptr, 16);
+        // Only process entries that can be parsed as integers
+        if (sscanf(entry->d_name, "%d", &pid) == 1) {
+            visit(pid);
         }
     }
 
-    return 0;
+    closedir(dir);
 }
 
 /**
- * Returns an array of the command line arguments as strings.
+ * Returns whether the given snapshot entry is to be listed, which needs both
+ * its exe and cwd, e.g. kernel threads have neither.
  */
-std::vector<std::string> get_proc_cmdline(pid_t pid) {
-    std::vector<std::string> cmdline_items;
-    std::istringstream cmdline_content_stream (get_proc_info_content(pid, "cmdline"));
+bool is_listed_entry(const procsnap::Buffer &buf, const procsnap::Entry &entry) {
+    return *buf.string(entry.exe) != '\0' && *buf.string(entry.cwd) != '\0';
+}
 
-    std::string arg;
+/**
+ * Fills the ProcInfo of the given snapshot entry. Returns false if the
+ * process is not to be listed.
+ */
+bool get_snapshot_proc_info(const procsnap::Buffer &buf,
+                            const procsnap::Entry &entry, ProcInfo &info) {
+    if (!is_listed_entry(buf, entry)) return false;
+
+    info.pid = entry.pid;
+    info.exe = buf.string(entry.exe);
+    info.cwd = buf.string(entry.cwd);
+    info.base_address = entry.base_address;
+    info.state = entry.state;
+    info.cmdline = parse_cmdline(buf.cmdline(entry));
+
+    return true;
+}
 
-    while (std::getline(cmdline_content_stream, arg, '\0')) {
-        std::istringstream arg_stream (arg);
-        std::string tmp;
+/**
+ * Gathers the information of the current processes from the snapshot
+ * published by procsnapd. Returns false if there is no usable snapshot.
+ */
+bool get_snapshot_proc_infos(std::vector<ProcInfo> &proc_infos, const SortOptions &options) {
+    stats::PhaseTimer timer {"snapshot"};
 
-        while (std::getline(arg_stream, tmp, ' ')) {
-            cmdline_items.push_back(arg);
+    return procsnap::read_snapshot([&](const procsnap::Buffer &buf) {
+        proc_infos.clear();
+
+        if (options.field == SortField::none) {
+            for (uint32_t i {0}; i < buf.size(); ++i) {
+                ProcInfo info;
+
+                if (get_snapshot_proc_info(buf, buf.entries[i], info)) {
+                    proc_infos.push_back(info);
+                }
+            }
+
+            return;
+        }
+
+        TopCandidates top {options.top, {}};
+
+        for (uint32_t i {0}; i < buf.size(); ++i) {
+            const procsnap::Entry &entry = buf.entries[i];
+            SortCandidate candidate {entry.pid, get_entry_sort_value(entry, options.field), i};
+
+            if (is_listed_entry(buf, entry) && top.accepts(candidate)) {
+                top.push(candidate);
+            }
+        }
+
+        for (const auto &candidate : top.sorted()) {
+            ProcInfo info;
+
+            if (get_snapshot_proc_info(buf, buf.entries[candidate.entry], info)) {
+                proc_infos.push_back(info);
+            }
         }
+    });
+}
+
+/**
+ * Reads the exe and cwd links of the given process from the procfs. Returns
+ * false if the process is not to be listed, e.g. kernel threads have
+ * neither.
+ */
+bool get_proc_links(pid_t pid, ProcInfo &info) {
+    stats::PhaseTimer timer {"readlink"};
+
+    info.pid = pid;
+
+    info.exe = get_proc_info_link(info.pid, "exe");
+    if (info.exe.empty()) {
+        count_if_vanished(info.pid);
+        return false;
     }
 
-    return cmdline_items;
+    info.cwd = get_proc_info_link(info.pid, "cwd");
+    if (info.cwd.empty()) {
+        count_if_vanished(info.pid);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Reads the base address and the cmdline of a process whose links have
+ * already been read. Neither decides whether the process is listed.
+ */
+void get_proc_details(ProcInfo &info) {
+    {
+        stats::PhaseTimer timer {"maps"};
+        info.base_address = get_proc_base_address(info.pid, info.exe);
+    }
+
+    {
+        stats::PhaseTimer timer {"cmdline"};
+        info.cmdline = get_proc_cmdline(info.pid);
+    }
+}
+
+/**
+ * Gathers the information of the given process from the procfs. Returns
+ * false if the process is not to be listed.
+ */
+bool get_proc_info(pid_t pid, ProcInfo &info) {
+    if (!get_proc_links(pid, info)) return false;
+
+    ProcStat proc_stat;
+
+    {
+        stats::PhaseTimer timer {"stat"};
+
+        if (!parse_proc_stat(info.pid, proc_stat)) {
+            count_if_vanished(info.pid);
+            return false;
+        }
+    }
+
+    info.state = proc_stat.state;
+
+    get_proc_details(info);
+
+    return true;
 }
 
 /**
  * Returns the gathered information of the current processes running on the
- * system.
+ * system, preferably from the procsnapd snapshot.
+ *
+ * When sorting, only the pid, sort value, state and links of the best
+ * candidates are kept during the scan, and everything else is only read for
+ * the ones that made it, so memory use depends on the top limit and not on
+ * the process count. Whether a process is listed is decided before it takes
+ * a place, so the top limit is always filled if there are enough processes.
  */
-std::vector<ProcInfo> get_proc_infos() {
+std::vector<ProcInfo> get_proc_infos(const SortOptions &options) {
     std::vector<ProcInfo> proc_infos;
-    DIR *dir = opendir("/proc");
-    dirent *entry = readdir(dir);
 
-    // Go through every directory entry in the procfs
-    while ((entry = readdir(dir)) != nullptr) {
-        ProcInfo info;
+    if (get_snapshot_proc_infos(proc_infos, options)) return proc_infos;
 
-        // Only process entries that can be parsed as integers
-        if (sscanf(entry->d_name, "%d", &info.pid) == 1) {
-            info.exe = get_proc_info_link(info.pid, "exe");
-            if (info.exe.empty()) continue;
+    stats::PhaseTimer timer {"scan"};
 
-            info.cwd = get_proc_info_link(info.pid, "cwd");
-            if (info.cwd.empty()) continue;
+    if (options.field == SortField::none) {
+        for_each_proc_pid([&](pid_t pid) {
+            ProcInfo info;
 
-            info.base_address = get_proc_base_address(info.pid, info.exe);
-            info.state = get_proc_state(info.pid);
-            info.cmdline = get_proc_cmdline(info.pid);
+            if (get_proc_info(pid, info)) {
+                proc_infos.push_back(info);
+            }
+        });
 
-            proc_infos.push_back(info);
-        }
+        return proc_infos;
     }
 
-    closedir(dir);
+    TopCandidates top {options.top, {}};
+
+    for_each_proc_pid([&](pid_t pid) {
+        ProcStat proc_stat;
+
+        {
+            stats::PhaseTimer timer {"stat"};
+
+            if (!parse_proc_stat(pid, proc_stat)) {
+                count_if_vanished(pid);
+                return;
+            }
+        }
+
+        SortCandidate candidate {pid, get_stat_sort_value(proc_stat, options.field)};
+        candidate.info.state = proc_stat.state;
+
+        if (!top.accepts(candidate)) return;
+        if (!get_proc_links(pid, candidate.info)) return;
+
+        top.push(std::move(candidate));
+    });
+
+    for (auto &candidate : top.sorted()) {
+        get_proc_details(candidate.info);
+        proc_infos.push_back(std::move(candidate.info));
+    }
 
     return proc_infos;
 }
@@ -187,6 +372,8 @@ std::vector<ProcInfo> get_proc_infos() {
  * Outputs the vector of ProcInfo as JSON to the standard output.
  */
 void print_proc_infos(std::vector<ProcInfo> proc_infos) {
+    stats::PhaseTimer timer {"output"};
+
     std::cout << "[";
 
     for (size_t i {0}; i < proc_infos.size(); ++i) {
@@ -200,10 +387,57 @@ void print_proc_infos(std::vector<ProcInfo> proc_infos) {
     std::cout << "]" << std::endl;
 }
 
-int main() {
-    std::vector<ProcInfo> proc_infos {get_proc_infos()};
+/**
+ * Parses the --sort and --top arguments. Returns false on invalid arguments.
+ */
+bool parse_sort_options(int argc, const char *argv[], SortOptions &options) {
+    for (int i {1}; i < argc; ++i) {
+        std::string arg {argv[i]};
+
+        if (arg == "--sort" && i + 1 < argc) {
+            std::string field {argv[++i]};
+
+            if (field == "mem") {
+                options.field = SortField::mem;
+            } else if (field == "cpu") {
+                options.field = SortField::cpu;
+            } else {
+                return false;
+            }
+        } else if (arg == "--top" && i + 1 < argc) {
+            const char *top {argv[++i]};
+            char *end;
+
+            // strtoul accepts a sign and wraps negative numbers around
+            if (*top < '0' || *top > '9') return false;
+
+            errno = 0;
+            options.top = strtoul(top, &end, 10);
+
+            if (*end != '\0' || errno == ERANGE || options.top == 0) return false;
+        } else {
+            return false;
+        }
+    }
+
+    // A limit without a field to rank by is meaningless
+    return options.top == 0 || options.field != SortField::none;
+}
+
+int APPLET_MAIN(ps)(int argc, const char *argv[]) {
+    stats::parse_flag(argc, argv);
+
+    SortOptions options;
+
+    if (!parse_sort_options(argc, argv, options)) {
+        std::cerr << "Usage: ./ps [--sort mem|cpu [--top N]] [--stats]" << std::endl;
+        return -1;
+    }
+
+    std::vector<ProcInfo> proc_infos {get_proc_infos(options)};
 
     print_proc_infos(proc_infos);
+    stats::report();
 
     return 0;
 }
@@ -1,6 +1,4 @@
 extern "C" {
-    #include <unistd.h>     /* read and readlink syscalls */
-    #include <fcntl.h>      /* open syscall */
     #include <dirent.h>     /* getdents64 syscall */
 }
 
@@ -12,54 +10,14 @@ extern "C" {
 #include <filesystem>
 #include <unordered_map>
 
-#define PROCFS_MOUNT        "/proc/"
-#define BUF_SIZE            8192
+#include "procfs.h"
+#include "procsnap.h"
+#include "stats.h"
+#include "multicall.h"
 
 namespace pstree {
     using children_map = std::unordered_map<pid_t, std::vector<pid_t>>;
-}
-
-void build_proc_path(std::ostringstream &oss) {
-    (void) oss; // ignore unused parameter
-}
-
-template<typename T, typename... Args>
-void build_proc_path(std::ostringstream &oss, const T& value, const Args&... args) {
-    oss << "/" << value;
-    build_proc_path(oss, args...);
-}
-
-/**
- * Builds a path to the procfs with a variable amount of arguments.
- */
-template<typename... Args>
-std::string build_proc_path(pid_t pid, Args&... args) {
-    std::ostringstream oss;
-
-    oss << PROCFS_MOUNT << pid;
-    build_proc_path(oss, args...);
-
-    return oss.str();
-}
-
-/**
- * Returns the content of a file under the /proc hierarchy.
- */
-template<typename... Args>
-std::string get_proc_info_content(pid_t pid, Args&... args) {
-    std::string proc_info_path {build_proc_path(pid, args...)};
-    char buf[BUF_SIZE];
-
-    int fd = open(proc_info_path.c_str(), O_RDONLY);
-    if (fd == -1) return {};
-
-    ssize_t nread = read(fd, buf, BUF_SIZE);
-    if (nread == -1) return {};
-
-    close(fd);
-    buf[nread] = '\0';
-
-    return std::string(buf, nread);
+    using names_map = std::unordered_map<pid_t, std::string>;
 }
 
 struct ProcInfoNode {
@@ -113,6 +71,7 @@ void add_to_children_map (pstree::children_map &proc_children, pid_t ppid, pid_t
  * Returns a hash map that maps the pids of all processes to their parents' pid.
  */
 pstree::children_map get_all_proc_children() {
+    stats::PhaseTimer timer {"scan"};
     pstree::children_map proc_children;
 
     DIR *dir = opendir("/proc");
@@ -124,16 +83,15 @@ pstree::children_map get_all_proc_children() {
 
         // Only process entries that can be parsed as integers
         if (sscanf(entry->d_name, "%d", &pid) == 1) {
-            std::istringstream stat_content_stream {get_proc_info_content(pid, "stat")};
+            ProcStat proc_stat;
 
-            std::string tmp;
-            pid_t ppid;
-
-            // The parent's pid is in the fourth place of the stat pseudo-file
-            stat_content_stream >> tmp >> tmp >> tmp >> ppid;
+            if (!parse_proc_stat(pid, proc_stat)) {
+                count_if_vanished(pid);
+                continue;
+            }
 
             // Add children pid to their parent process
-            add_to_children_map(proc_children, ppid, pid);
+            add_to_children_map(proc_children, proc_stat.ppid, pid);
         }
     }
 
@@ -142,6 +100,27 @@ pstree::children_map get_all_proc_children() {
     return proc_children;
 }
 
+/**
+ * Fills the hash maps of all processes' children and names from the snapshot
+ * published by procsnapd. Returns false if there is no usable snapshot.
+ */
+bool get_snapshot_proc_children(pstree::children_map &proc_children,
+                                pstree::names_map &proc_names) {
+    stats::PhaseTimer timer {"snapshot"};
+
+    return procsnap::read_snapshot([&](const procsnap::Buffer &buf) {
+        proc_children.clear();
+        proc_names.clear();
+
+        for (uint32_t i {0}; i < buf.size(); ++i) {
+            const procsnap::Entry &entry = buf.entries[i];
+
+            add_to_children_map(proc_children, entry.ppid, entry.pid);
+            proc_names[entry.pid] = buf.string(entry.comm);
+        }
+    });
+}
+
 /**
  * Returns the processes' name as stated in the /proc/pid/comm pseudo-file.
  */
@@ -156,17 +135,26 @@ std::string get_proc_name(pid_t pid) {
 
 /**
  * Returns a ProcInfoNode that goes through the processes' children
- * recursively.
+ * recursively. The names are taken from the snapshot if there is one, which
+ * holds every process but the pseudo-process #0, so the procfs is never read.
  */
-ProcInfoNode get_proc_tree(pid_t pid, pstree::children_map proc_children) {
+ProcInfoNode get_proc_tree(pid_t pid, pstree::children_map &proc_children,
+                           const pstree::names_map &proc_names, bool from_snapshot) {
     ProcInfoNode parent;
 
     parent.pid = pid;
-    parent.name = get_proc_name(pid);
+
+    if (from_snapshot) {
+        auto name = proc_names.find(pid);
+        if (name != proc_names.end()) parent.name = name->second;
+    } else {
+        parent.name = get_proc_name(pid);
+    }
 
     // Recursively add children nodes
     for (const auto &child_pid : proc_children[pid]) {
-        parent.children.push_back(get_proc_tree(child_pid, proc_children));
+        parent.children.push_back(get_proc_tree(child_pid, proc_children, proc_names,
+                                                from_snapshot));
     }
 
     return parent;
@@ -176,6 +164,8 @@ ProcInfoNode get_proc_tree(pid_t pid, pstree::children_map proc_children) {
  * Prints the given node as a tree in JSON.
  */
 void print_proc_tree(ProcInfoNode root) {
+    stats::PhaseTimer timer {"output"};
+
     std::cout << "[";
 
     std::cout << root.to_json();
@@ -187,6 +177,8 @@ void print_proc_tree(ProcInfoNode root) {
  * Prints the list of given nodes as a list in JSON.
  */
 void print_proc_tree_list(std::vector<ProcInfoNode> proc_tree_list) {
+    stats::PhaseTimer timer {"output"};
+
     std::cout << "[";
 
     for (size_t i {0}; i < proc_tree_list.size(); ++i) {
@@ -200,27 +192,48 @@ void print_proc_tree_list(std::vector<ProcInfoNode> proc_tree_list) {
     std::cout << "]" << std::endl;
 }
 
-int main(int argc, const char *argv[]) {
-    auto proc_children = get_all_proc_children();
+int APPLET_MAIN(pstree)(int argc, const char *argv[]) {
+    stats::parse_flag(argc, argv);
+
+    pstree::children_map proc_children;
+    pstree::names_map proc_names;
+    bool from_snapshot = get_snapshot_proc_children(proc_children, proc_names);
+
+    if (!from_snapshot) {
+        proc_children = get_all_proc_children();
+    }
 
     if (argc > 1) {
         // If a valid process id is given, output the children of that one
         pid_t pid = strtoul(argv[1], nullptr, 10);
+        bool exists = from_snapshot ?
+            proc_names.count(pid) > 0 :
+            std::filesystem::is_directory("/proc/" + std::to_string(pid));
 
-        if (!std::filesystem::is_directory("/proc/" + std::to_string(pid))) {
+        if (!exists) {
             std::cerr << "There is no process with the pid " << pid << std::endl;
             return -1;
         }
 
-        ProcInfoNode root {get_proc_tree(pid, proc_children)};
+        ProcInfoNode root;
+        {
+            stats::PhaseTimer timer {"tree"};
+            root = get_proc_tree(pid, proc_children, proc_names, from_snapshot);
+        }
 
         print_proc_tree(root);
     } else {
         // By default, output the children of the parent process #0
-        std::vector<ProcInfoNode> proc_tree_list {get_proc_tree(0, proc_children).children};
+        std::vector<ProcInfoNode> proc_tree_list;
+        {
+            stats::PhaseTimer timer {"tree"};
+            proc_tree_list = get_proc_tree(0, proc_children, proc_names, from_snapshot).children;
+        }
 
         print_proc_tree_list(proc_tree_list);
     }
 
+    stats::report();
+
     return 0;
 }
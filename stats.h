@@ -0,0 +1,153 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include "nolibc.h"     /* now_ns, getrusage, err writer */
+
+#define STATS_FLAG          "--stats"
+#define STATS_MAX_PHASES    16
+
+/*
+ * Instrumentation behind the --stats flag. Phases are measured as self time:
+ * while a nested phase runs, the time is charged to it and not to the phase
+ * around it. Nothing is measured until the flag is given, the counters are
+ * plain increments.
+ */
+namespace stats {
+    struct Phase {
+        const char *name;
+        long long ns;
+    };
+
+    struct Stats {
+        bool enabled {false};
+        unsigned long long files_opened {0};
+        unsigned long long bytes_read {0};
+        unsigned long long pids_vanished {0};
+
+        Phase phases[STATS_MAX_PHASES] {};
+        size_t nphases {0};
+        int current {-1};           /* index of the running phase */
+        long long last_switch {0};  /* when the running phase was entered */
+    };
+
+    inline constinit Stats collected;
+
+    /**
+     * Returns the index of the phase with the given name, which is added if
+     * it does not exist yet. Returns -1 if there are too many phases.
+     */
+    inline int find_phase(const char *name) {
+        for (size_t i = 0; i < collected.nphases; ++i) {
+            if (nolibc::str_equal(collected.phases[i].name, name)) return i;
+        }
+
+        if (collected.nphases == STATS_MAX_PHASES) return -1;
+
+        collected.phases[collected.nphases] = {name, 0};
+
+        return collected.nphases++;
+    }
+
+    /**
+     * Charges the time since the last switch to the running phase and makes
+     * the given phase the running one.
+     */
+    inline void switch_phase(int phase) {
+        long long now = nolibc::now_ns();
+
+        if (collected.current >= 0) {
+            collected.phases[collected.current].ns += now - collected.last_switch;
+        }
+
+        collected.current = phase;
+        collected.last_switch = now;
+    }
+
+    /**
+     * Measures the time of the enclosing scope as the given phase.
+     */
+    struct PhaseTimer {
+        int previous {-1};
+
+        explicit PhaseTimer(const char *name) {
+            if (!collected.enabled) return;
+
+            previous = collected.current;
+            switch_phase(find_phase(name));
+        }
+
+        ~PhaseTimer() {
+            if (!collected.enabled) return;
+
+            switch_phase(previous);
+        }
+    };
+
+    /**
+     * Counts a procfs file that was opened and read.
+     */
+    inline void count_read(long nread) {
+        ++collected.files_opened;
+        if (nread > 0) collected.bytes_read += nread;
+    }
+
+    /**
+     * Counts a pid that vanished while the procfs was scanned.
+     */
+    inline void count_vanished() {
+        ++collected.pids_vanished;
+    }
+
+    /**
+     * Enables the instrumentation if the --stats flag is given and removes
+     * the flag from the arguments.
+     */
+    inline void parse_flag(int &argc, const char *argv[]) {
+        int j = 0;
+
+        for (int i = 0; i < argc; ++i) {
+            if (i > 0 && nolibc::str_equal(argv[i], STATS_FLAG)) {
+                collected.enabled = true;
+            } else {
+                argv[j++] = argv[i];
+            }
+        }
+
+        argc = j;
+    }
+
+    inline void report_line(const char *key, const char *name,
+                            unsigned long long value, const char *unit) {
+        nolibc::err.write("stats: ");
+        nolibc::err.write(key);
+        nolibc::err.write(name);
+        nolibc::err.write(" ");
+        nolibc::err.write_uint(value);
+        nolibc::err.write(unit);
+        nolibc::err.write("\n");
+    }
+
+    /**
+     * Prints the collected stats to the standard error, if enabled.
+     */
+    inline void report() {
+        if (!collected.enabled) return;
+
+        struct rusage usage;
+        nolibc::getrusage(RUSAGE_SELF, &usage);
+
+        for (size_t i = 0; i < collected.nphases; ++i) {
+            report_line("phase ", collected.phases[i].name,
+                        collected.phases[i].ns / 1000, " us");
+        }
+
+        report_line("procfs files opened", "", collected.files_opened, "");
+        report_line("procfs bytes read", "", collected.bytes_read, "");
+        report_line("pids vanished", "", collected.pids_vanished, "");
+        report_line("peak rss", "", usage.ru_maxrss, " kB");
+
+        nolibc::err.flush();
+    }
+}
+
+#endif
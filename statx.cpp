@@ -1,72 +1,21 @@
-extern "C" {
-    #include <unistd.h>     /* write syscall */
-    #include <fcntl.h>      /* AT_ constants */
-    #include <sys/stat.h>   /* statx syscall, statx struct */
-}
+#include "nolibc.h"     /* statx syscall, statx struct, print helpers */
+#include "multicall.h"  /* APPLET_MAIN */
 
-#define FD_STDOUT       1
-#define FD_STDERR       2
 #define STATX_FLAGS     AT_SYMLINK_NOFOLLOW
 #define OWNER_MASK      STATX_UID | STATX_GID
 #define SIZE_MASK       STATX_SIZE
 #define MODE_MASK       STATX_MODE
 
-/**
- * Return the length of a given c-style char string. Assumes that the string is
- * terminated with a null-byte character.
- */
-size_t strlen(const char *str) {
-    const char *ptr = str;
-
-    // traverse the string until a null-byte occurs
-    while (*ptr != '\0') ++ptr;
-
-    // get length from pointer positions
-    return (ptr - str);
-}
-
-/**
- * Prints the given string to console.
- */
-void print(const char *str = "", int fd = FD_STDOUT) {
-    write(fd, str, strlen(str));
-}
-
-/**
- * Print the given string as a line to console.
- */
-void println(const char *str = "", int fd = FD_STDOUT) {
-    print(str, fd);
-    print("\n", fd);
-}
-
-/**
- * Convert an unsigned integer to a c-style string.
- */
-void uint_to_str(unsigned int num, char str[]) {
-    int i = 0;
-
-    do {
-        str[i++] = num % 10 + '0';
-        num /= 10;
-    } while (num > 0);
-
-    str[i] = '\0';
-
-    int len = i;
-    for (i = 0; i < len / 2; ++i) {
-        char tmp = str[i];
-        str[i] = str[len - i - 1];
-        str[len - i - 1] = tmp;
-    }
-}
+using nolibc::print;
+using nolibc::println;
+using nolibc::uint_to_str;
 
 /**
  * Wrapper for statx syscall with error message
  */
 int call_statx(const char pathname[], unsigned int mask,
                 struct statx *statxbuf) {
-    int ret = statx(AT_FDCWD, pathname, STATX_FLAGS, mask, statxbuf);
+    int ret = nolibc::statx(AT_FDCWD, pathname, STATX_FLAGS, mask, statxbuf);
 
     if (ret != 0) {
         println("Error: Syscall statx() failed", FD_STDERR);
@@ -78,7 +27,7 @@ int call_statx(const char pathname[], unsigned int mask,
 /**
  * Convert the statx_mode to a ls-style permissions string
  */
-void mode_to_string(mode_t mode, char perms[]) {
+void mode_to_string(unsigned int mode, char perms[]) {
     perms[0] = mode & S_IRUSR ? 'r' : '-';
     perms[1] = mode & S_IWUSR ? 'w' : '-';
     perms[2] = mode & S_IXUSR ? 'x' : '-';
@@ -91,7 +40,7 @@ void mode_to_string(mode_t mode, char perms[]) {
     perms[9] = '\0';
 }
 
-int main(int argc, const char *argv[]) {
+int APPLET_MAIN(statx)(int argc, const char *argv[]) {
     if (argc < 2) {
         println("Usage: ./statx FILE", FD_STDERR);
         return -1;
@@ -107,9 +56,9 @@ int main(int argc, const char *argv[]) {
     if (call_statx(pathname, MODE_MASK, &modestat) != 0) return -1;
 
     // Assuming u32 for uid & gid and u64 for size
-    char uid[10];
-    char gid[10];
-    char size[20];
+    char uid[21];
+    char gid[21];
+    char size[21];
     char perms[10];
 
     uint_to_str(ownerstat.stx_uid, uid);